@@ -8,19 +8,24 @@
 #include <chrono>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <numeric>
 #include <thread>
 #include <vector>
 #include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
 
-#include <intrin.h>
+#include "rsqrt.h"
 
 using std::cin;
 using std::cout;
 using std::endl;
 using std::flush;
 
-using single_float_operation = float (*)(float);
+using namespace rsqrt;
 
 struct FloatOperationBenchResult
 {
@@ -96,138 +101,42 @@ FloatOperationBenchResult TestSum(size_t iterations, const char* name)
     return { timer.getDuration(), sum, name };
 }
 
-void IterateAllPositiveFloats(void(*op)(void* userData, float value, int32_t index), void* userData)
+template<batch_16bit_operation op>
+FloatOperationBenchResult TestBatch16Bit(const std::vector<uint16_t>& input, std::vector<uint16_t>& output, float (*toFloat)(uint16_t), const char* name)
 {
-    Float_t allFloats;
-    allFloats.f = 0.0f;
-
-    op(userData, allFloats.f, allFloats.i);
+    Timer timer;
+    timer.start();
+    op(input.data(), output.data(), input.size());
+    timer.stop();
+    float sum = 0.0f;
+    for (const auto value : output)
+        sum += toFloat(value);
+    return { timer.getDuration(), sum, name };
+}
 
 #if defined(_DEBUG)
-    while (allFloats.RawExponent() < 2)
+constexpr uint32_t positive_floats_end = (2u << 23) + 1;
 #else
-    while (allFloats.RawExponent() < 255)
+constexpr uint32_t positive_floats_end = (255u << 23) + 1; // up to infinity
 #endif
-    {
-        allFloats.i += 1;
-        op(userData, allFloats.f, allFloats.i);
-    }
-}
-
-float InvSqrtReference(float arg)
-{
-    return 1.0f / std::sqrt(arg);
-}
-
-float InvSqrtAccurate(float arg)
-{
-    const __m128 vec = _mm_load_ss(&arg);
-    const __m128 sqrt = _mm_sqrt_ss(vec);
-    const __m128 rsqrt = _mm_div_ss(_mm_set_ss(1.0f), sqrt);
-    return _mm_cvtss_f32(rsqrt);
-}
-
-float InvSqrtAccurate2(float arg)
-{
-    return _mm_cvtss_f32(_mm_div_ss(_mm_set_ss(1.0f), _mm_sqrt_ss(_mm_load_ss(&arg))));
-}
-
-float InvSqrtFast(float arg)
-{
-    const __m128 vec = _mm_load_ss(&arg);
-    const __m128 guess = _mm_rsqrt_ss(vec);
-    return _mm_cvtss_f32(guess);
-}
-
-float InvSqrtFast2(float arg)
-{
-    return _mm_cvtss_f32(_mm_rsqrt_ss(_mm_load_ss(&arg)));
-}
 
-float InvSqrtImprovedFast(float arg)
+void IterateFloats(void(*op)(void* userData, float value, int32_t index), void* userData, uint32_t begin, uint32_t end)
 {
-    const __m128 vec = _mm_load_ss(&arg);
-    __m128 guess = _mm_rsqrt_ss(vec);
-    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(_mm_set_ss(-0.5f), _mm_mul_ss(vec, _mm_mul_ss(guess, guess)))));
-    return _mm_cvtss_f32(guess);
-}
-
-float InvSqrtImprovedFast2(float arg)
-{
-    const __m128 vec = _mm_load_ss(&arg);
-    __m128 guess = _mm_rsqrt_ss(vec);
-    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(_mm_set_ss(-0.5f), _mm_mul_ss(vec, _mm_mul_ss(guess, guess)))));
-    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(_mm_set_ss(-0.5f), _mm_mul_ss(vec, _mm_mul_ss(guess, guess)))));
-    return _mm_cvtss_f32(guess);
-}
-
-float InvSqrtImprovedFast3(float arg)
-{
-    const __m128 vec = _mm_load_ss(&arg);
-    const __m128 vec2 = _mm_mul_ss(_mm_set_ss(-0.5f), vec);
-    __m128 guess = _mm_rsqrt_ss(vec);
-    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(vec2, _mm_mul_ss(guess, guess))));
-    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(vec2, _mm_mul_ss(guess, guess))));
-    return _mm_cvtss_f32(guess);
-}
-
-constexpr int32_t least_significant_mantisa_mask = 0b11111111111111111110000000000000;
-
-float InvSqrtFastMasked(float arg)
-{
-    const __m128 vec = _mm_load_ss(&arg);
-    const __m128 mantisa_mask = _mm_castsi128_ps(_mm_set1_epi32(least_significant_mantisa_mask));
-    __m128 guess = _mm_rsqrt_ss(vec);
-    guess = _mm_and_ps(mantisa_mask, guess);
-    return _mm_cvtss_f32(guess);
-}
-
-float InvSqrtImprovedFastMasked(float arg)
-{
-    const __m128 vec = _mm_load_ss(&arg);
-    const __m128 mantisa_mask = _mm_castsi128_ps(_mm_set1_epi32(least_significant_mantisa_mask));
-    __m128 guess = _mm_rsqrt_ss(vec);
-    guess = _mm_and_ps(mantisa_mask, guess);
-    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(_mm_set_ss(-0.5f), _mm_mul_ss(vec, _mm_mul_ss(guess, guess)))));
-    return _mm_cvtss_f32(guess);
-}
-
-float InvSqrtImprovedFastMasked2(float arg)
-{
-    const __m128 vec = _mm_load_ss(&arg);
-    const __m128 mantisa_mask = _mm_castsi128_ps(_mm_set1_epi32(least_significant_mantisa_mask));
-    __m128 guess = _mm_rsqrt_ss(vec);
-    guess = _mm_and_ps(mantisa_mask, guess);
-    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(_mm_set_ss(-0.5f), _mm_mul_ss(vec, _mm_mul_ss(guess, guess)))));
-    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(_mm_set_ss(-0.5f), _mm_mul_ss(vec, _mm_mul_ss(guess, guess)))));
-    return _mm_cvtss_f32(guess);
-}
-
-float InvSqrtSoftFastApprox(float arg)
-{
-    const int32_t guessInt = 0x5f3759df - ((*reinterpret_cast<uint32_t*>(&arg)) >> 1);
-    return *reinterpret_cast<const float*>(&guessInt);
+    Float_t value;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        value.i = static_cast<int32_t>(i);
+        op(userData, value.f, value.i);
+    }
 }
 
-float InvSqrtSoftFastApprox2(float arg)
+void IterateAllPositiveFloats(void(*op)(void* userData, float value, int32_t index), void* userData)
 {
-    const int32_t guessInt = 0x5F1FFFF9 - ((*reinterpret_cast<uint32_t*>(&arg)) >> 1);
-    return *reinterpret_cast<const float*>(&guessInt);
+    IterateFloats(op, userData, 0, positive_floats_end);
 }
 
-float InvSqrtSoftFastApproxSSE(float arg)
-{
-    const __m128 number = _mm_load_ss(&arg);
-    __m128 guess = _mm_castsi128_ps(_mm_sub_epi32(_mm_set1_epi32(0x5f3759df), _mm_srai_epi32(_mm_castps_si128(number), 1)));
-    return _mm_cvtss_f32(guess);
-}
-
-float InvSqrtSoftFastApproxSSE2(float arg)
-{
-    const __m128 number = _mm_load_ss(&arg);
-    __m128 guess = _mm_castsi128_ps(_mm_sub_epi32(_mm_set1_epi32(0x5F1FFFF9), _mm_srai_epi32(_mm_castps_si128(number), 1)));
-    return _mm_cvtss_f32(guess);
-}
+// Used only by bench_rsqrt to measure pointer cast punning against BitCast (InvSqrtSoftFastApproxImproved3/4 from
+// rsqrt.h), error tests use the rsqrt.h versions.
 
 float InvSqrtSoftFastApproxImproved(float arg)
 {
@@ -260,66 +169,44 @@ float InvSqrtSoftFastApproxImproved2(float arg)
     return y;
 }
 
-float InvSqrtSoftFastApproxImproved3(float arg)
-{
-    uint32_t i;
-    float x2, y;
-    const float threehalfs = 1.5F;
-
-    x2 = arg * 0.5F;
-    y = arg;
-    memcpy(&i, &y, sizeof(y));
-    i = 0x5f3759df - (i >> 1);
-    memcpy(&y, &i, sizeof(y));
-    y = y * (threehalfs - (x2 * y * y));
-    return y;
-}
-
-float InvSqrtSoftFastApproxImproved4(float arg)
-{
-    uint32_t i;
-    float y;
-
-    y = arg;
-    memcpy(&i, &y, sizeof(y));
-    i = 0x5F1FFFF9 - (i >> 1);
-    memcpy(&y, &i, sizeof(y));
-    y = y * (0.703952253f * (2.38924456f - (arg * y * y)));
-    return y;
-}
-
-float InvSqrtSoftFastApproxImprovedSSE1(float arg)
-{
-    const int32_t guessInt = 0x5f3759df - ((*reinterpret_cast<uint32_t*>(&arg)) >> 1);
-    __m128 guess = _mm_castsi128_ps(_mm_set1_epi32(guessInt));
-    const __m128 arg2 = _mm_mul_ss(_mm_set_ss(-0.5f), _mm_load_ss(&arg));
-    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(arg2, _mm_mul_ss(guess, guess))));
-    return _mm_cvtss_f32(guess);
-}
-
-float InvSqrtSoftFastApproxImprovedSSE2(float arg)
+template<size_t repeats, size_t tests>
+void ReportBenchResults(const FloatOperationBenchResult (&benchmarks)[repeats][tests], size_t iterations)
 {
-    const int32_t guessInt = 0x5F1FFFF9 - ((*reinterpret_cast<uint32_t*>(&arg)) >> 1);
-    __m128 guess = _mm_castsi128_ps(_mm_set1_epi32(guessInt));
-    guess = _mm_mul_ss(_mm_set_ss(0.703952253f), _mm_mul_ss(guess, _mm_sub_ss(_mm_set_ss(2.38924456f), _mm_mul_ss(_mm_load_ss(&arg), _mm_mul_ss(guess, guess)))));
-    return _mm_cvtss_f32(guess);
-}
+    double referenceAvg = 0.0f;
+    double referenceMedian = 0.0f;
 
-float InvSqrtSoftFastApproxImprovedSSE3(float arg)
-{
-    const __m128 number = _mm_load_ss(&arg);
-    __m128 guess = _mm_castsi128_ps(_mm_sub_epi32(_mm_set1_epi32(0x5f3759df), _mm_srai_epi32(_mm_castps_si128(number), 1)));
-    const __m128 arg2 = _mm_mul_ss(_mm_set_ss(-0.5f), number);
-    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(arg2, _mm_mul_ss(guess, guess))));
-    return _mm_cvtss_f32(guess);
-}
+    cout << "Iterations: " << iterations << ". Repeats: " << repeats << "." << endl;
+    for (size_t test = 0; test < tests; ++test)
+    {
+        const auto& firstBench = benchmarks[0][test];
 
-float InvSqrtSoftFastApproxImprovedSSE4(float arg)
-{
-    const __m128 number = _mm_load_ss(&arg);
-    __m128 guess = _mm_castsi128_ps(_mm_sub_epi32(_mm_set1_epi32(0x5F1FFFF9), _mm_srai_epi32(_mm_castps_si128(number), 1)));
-    guess = _mm_mul_ss(_mm_set_ss(0.703952253f), _mm_mul_ss(guess, _mm_sub_ss(_mm_set_ss(2.38924456f), _mm_mul_ss(number, _mm_mul_ss(guess, guess)))));
-    return _mm_cvtss_f32(guess);
+        std::vector<double> durations;
+        for (size_t i = 0; i < repeats; ++i)
+        {
+            const auto bench = benchmarks[i][test];
+            for (size_t j = i + 1; j < repeats; ++j)
+            {
+                const auto otherBench = benchmarks[j][test];
+                assert(bench.result == otherBench.result && "corrupted data");
+            }
+            durations.push_back(bench.duration);
+        }
+        std::sort(durations.begin(), durations.end());
+        const auto avg = std::accumulate(durations.begin(), durations.end(), 0.0) / static_cast<double>(repeats);
+        const auto median = durations[repeats / 2];
+        if (test == 0)
+        {
+            referenceAvg = avg;
+            referenceMedian = median;
+        }
+        
+        cout << "Test: " << firstBench.name << endl;
+        cout << "\t- result:            " << firstBench.result << endl;
+        cout << "\t- avg duration:      " << avg << endl;
+        cout << "\t- median duration:   " << median << endl;
+        cout << "\t- avg speed gain:    " << (referenceAvg / avg) << endl;
+        cout << "\t- median speed gain: " << (referenceMedian / median) << endl;
+    }
 }
 
 void bench_rsqrt()
@@ -358,8 +245,8 @@ void bench_rsqrt()
         benchmarks[i][test++] = TestSum<InvSqrtSoftFastApproxSSE2>(iterations, "Software fast approx (SSE, better constant)");
         benchmarks[i][test++] = TestSum<InvSqrtSoftFastApproxImproved>(iterations, "Software fast approx + single Newton-Raphson iteration (unsafe cast)");
         benchmarks[i][test++] = TestSum<InvSqrtSoftFastApproxImproved2>(iterations, "Software fast approx + single Newton-Raphson iteration (unsafe cast, better constants)");
-        benchmarks[i][test++] = TestSum<InvSqrtSoftFastApproxImproved3>(iterations, "Software fast approx + single Newton-Raphson iteration (memcopy instead unsafe cast)");
-        benchmarks[i][test++] = TestSum<InvSqrtSoftFastApproxImproved4>(iterations, "Software fast approx + single Newton-Raphson iteration (memcopy instead unsafe cast, better constants)");
+        benchmarks[i][test++] = TestSum<InvSqrtSoftFastApproxImproved3>(iterations, "Software fast approx + single Newton-Raphson iteration (BitCast instead unsafe cast)");
+        benchmarks[i][test++] = TestSum<InvSqrtSoftFastApproxImproved4>(iterations, "Software fast approx + single Newton-Raphson iteration (BitCast instead unsafe cast, better constants)");
         benchmarks[i][test++] = TestSum<InvSqrtSoftFastApproxImprovedSSE1>(iterations, "Software fast approx + single Newton-Raphson iteration (integer on ALU, float on SSE)");
         benchmarks[i][test++] = TestSum<InvSqrtSoftFastApproxImprovedSSE2>(iterations, "Software fast approx + single Newton-Raphson iteration (integer on ALU, float on SSE, better constants)");
         benchmarks[i][test++] = TestSum<InvSqrtSoftFastApproxImprovedSSE3>(iterations, "Software fast approx + single Newton-Raphson iteration (all on SSE)");
@@ -367,43 +254,171 @@ void bench_rsqrt()
         assert(test == tests);
     }
 
-    double referenceAvg = 0.0f;
-    double referenceMedian = 0.0f;
+    ReportBenchResults(benchmarks, iterations);
+}
+
+std::vector<uint16_t> Create16BitSamples(size_t count, uint16_t infinity)
+{
+    // walk over all positive finite non-zero values, the same way for each tested format
+    std::vector<uint16_t> samples(count);
+    for (size_t i = 0; i < count; ++i)
+        samples[i] = static_cast<uint16_t>(1 + i % (infinity - 1));
+    return samples;
+}
+
+void bench_rsqrt_16bit()
+{
+    constexpr size_t repeats = 20;
+    constexpr size_t tests = 3;
+
+    const size_t iterations = 1000 * 1000 * 10;
 
-    cout << "Iterations: " << iterations << ". Repeats: " << repeats << "." << endl;
-    for (size_t test = 0; test < tests; ++test)
     {
-        const auto& firstBench = benchmarks[0][test];
+        const auto input = Create16BitSamples(iterations, half_infinity);
+        std::vector<uint16_t> output(iterations);
 
-        std::vector<double> durations;
+        FloatOperationBenchResult benchmarks[repeats][tests];
         for (size_t i = 0; i < repeats; ++i)
         {
-            const auto bench = benchmarks[i][test];
-            for (size_t j = i + 1; j < repeats; ++j)
-            {
-                const auto otherBench = benchmarks[j][test];
-                assert(bench.result == otherBench.result && "corrupted data");
-            }
-            durations.push_back(bench.duration);
+            size_t test = 0;
+            benchmarks[i][test++] = TestBatch16Bit<InvSqrtHalfConvertedBatch>(input, output, HalfToFloat, "Half: convert to float + hardware fast + single Newton-Raphson iteration");
+            benchmarks[i][test++] = TestBatch16Bit<InvSqrtHalfFastBatch>(input, output, HalfToFloat, "Half: batch hardware fast");
+            benchmarks[i][test++] = TestBatch16Bit<InvSqrtHalfImprovedFastBatch>(input, output, HalfToFloat, "Half: batch hardware fast + single Newton-Raphson iteration");
+            assert(test == tests);
         }
-        std::sort(durations.begin(), durations.end());
-        const auto avg = std::accumulate(durations.begin(), durations.end(), 0.0) / static_cast<double>(repeats);
-        const auto median = durations[repeats / 2];
-        if (test == 0)
+        ReportBenchResults(benchmarks, iterations);
+    }
+
+    {
+        const auto input = Create16BitSamples(iterations, bfloat16_infinity);
+        std::vector<uint16_t> output(iterations);
+
+        FloatOperationBenchResult benchmarks[repeats][tests];
+        for (size_t i = 0; i < repeats; ++i)
         {
-            referenceAvg = avg;
-            referenceMedian = median;
+            size_t test = 0;
+            benchmarks[i][test++] = TestBatch16Bit<InvSqrtBFloat16ConvertedBatch>(input, output, BFloat16ToFloat, "BFloat16: convert to float + hardware fast + single Newton-Raphson iteration");
+            benchmarks[i][test++] = TestBatch16Bit<InvSqrtBFloat16FastBatch>(input, output, BFloat16ToFloat, "BFloat16: batch hardware fast");
+            benchmarks[i][test++] = TestBatch16Bit<InvSqrtBFloat16ImprovedFastBatch>(input, output, BFloat16ToFloat, "BFloat16: batch hardware fast + single Newton-Raphson iteration");
+            assert(test == tests);
         }
-        
-        cout << "Test: " << firstBench.name << endl;
-        cout << "\t- result:            " << firstBench.result << endl;
-        cout << "\t- avg duration:      " << avg << endl;
-        cout << "\t- median duration:   " << median << endl;
-        cout << "\t- avg speed gain:    " << (referenceAvg / avg) << endl;
-        cout << "\t- median speed gain: " << (referenceMedian / median) << endl;
+        ReportBenchResults(benchmarks, iterations);
     }
 }
 
+struct StreamMode
+{
+    const char* name;
+    bool inPlace;
+    bool nonTemporal;
+    bool prefetch;
+};
+
+const StreamMode stream_modes[] =
+{
+    { "out-of-place, regular stores", false, false, false },
+    { "out-of-place, regular stores, prefetch", false, false, true },
+    { "out-of-place, non-temporal stores", false, true, false },
+    { "out-of-place, non-temporal stores, prefetch", false, true, true },
+    { "in-place, regular stores", true, false, false },
+    { "in-place, regular stores, prefetch", true, false, true },
+    { "in-place, non-temporal stores", true, true, false },
+    { "in-place, non-temporal stores, prefetch", true, true, true },
+};
+
+constexpr size_t stream_min_working_set = 16 * 1024;
+constexpr uint64_t stream_default_max_working_set = 4ull * 1024 * 1024 * 1024;
+
+std::string FormatBytes(size_t bytes)
+{
+    const char* units[] = { "B", "KB", "MB", "GB" };
+    size_t unit = 0;
+    while (unit + 1 < sizeof(units) / sizeof(units[0]) && bytes >= 1024 && bytes % 1024 == 0)
+    {
+        bytes /= 1024;
+        ++unit;
+    }
+    return std::to_string(bytes) + " " + units[unit];
+}
+
+// Returns duration of single pass over working set. Working set is all memory touched by the pass:
+// one array for in-place mode, input and output arrays (half of working set each) otherwise.
+double MeasureStream(const KernelInfo& kernel, const StreamMode& mode, float* buffer, size_t workingSet, size_t& elements)
+{
+    constexpr double minDuration = 0.05;
+
+    elements = (mode.inPlace ? workingSet : workingSet / 2) / sizeof(float);
+    const float* input = buffer;
+    float* output = mode.inPlace ? buffer : buffer + elements;
+
+    // warm up, it also touches all pages of the working set
+    kernel.stream(input, output, elements, mode.nonTemporal, mode.prefetch);
+
+    size_t passes = 1;
+    for (;;)
+    {
+        Timer timer;
+        timer.start();
+        for (size_t pass = 0; pass < passes; ++pass)
+            kernel.stream(input, output, elements, mode.nonTemporal, mode.prefetch);
+        timer.stop();
+        if (timer.getDuration() >= minDuration)
+            return timer.getDuration() / static_cast<double>(passes);
+        passes *= 2;
+    }
+}
+
+// The whole working set is filled before measuring, so it must fit in physical memory: on systems that overcommit
+// the allocation succeeds anyway and the fallback to smaller sizes below only covers failed allocations.
+bool bench_rsqrt_stream(uint64_t maxWorkingSet = stream_default_max_working_set)
+{
+    size_t bufferSize = static_cast<size_t>(std::min<uint64_t>(maxWorkingSet, std::numeric_limits<size_t>::max() / 2 + 1));
+    float* buffer = nullptr;
+    while (bufferSize >= stream_min_working_set && (buffer = static_cast<float*>(_mm_malloc(bufferSize, 64))) == nullptr)
+        bufferSize /= 2;
+    if (buffer == nullptr)
+    {
+        cout << "Can't allocate memory for stream test." << endl;
+        return false;
+    }
+    for (size_t i = 0; i < bufferSize / sizeof(float); ++i)
+        buffer[i] = 1.0f + static_cast<float>(i % 1024);
+
+    cout << "Stream test working sets: " << FormatBytes(stream_min_working_set) << " - " << FormatBytes(bufferSize) << "." << endl;
+    for (uint32_t kernel = 0; kernel < static_cast<uint32_t>(Kernel::Count); ++kernel)
+    {
+        const KernelInfo& kernelInfo = GetKernelInfo(static_cast<Kernel>(kernel));
+        for (const auto& mode : stream_modes)
+        {
+            cout << "Stream test: " << kernelInfo.name << ", " << mode.name << endl;
+            printf("%11s, %10s, %10s\n", "working set", "GB/s", "Melem/s");
+            for (size_t workingSet = stream_min_working_set; workingSet != 0 && workingSet <= bufferSize; workingSet *= 2)
+            {
+                size_t elements = 0;
+                const double duration = MeasureStream(kernelInfo, mode, buffer, workingSet, elements);
+                // each element is read once and written once
+                const double bytes = static_cast<double>(elements) * 2 * sizeof(float);
+                printf("%11s, %10.2f, %10.1f\n", FormatBytes(workingSet).c_str(), bytes / duration / 1e9, elements / duration / 1e6);
+            }
+        }
+    }
+
+    _mm_free(buffer);
+    return true;
+}
+
+template<typename T>
+void WriteValue(std::ostream& stream, const T& value)
+{
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template<typename T>
+void ReadValue(std::istream& stream, T& value)
+{
+    stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+}
+
 struct Error
 {
     float errorValue;
@@ -491,6 +506,63 @@ struct ErrorTestData
         ++samples;
         errorAvg = ((samples - 1) * errorAvg + errorHighPrecision) / (double)samples;
     }
+
+    void merge(const ErrorTestData& other)
+    {
+        hasResultNaN = hasResultNaN || other.hasResultNaN;
+
+        if (inputValueMin > other.inputValueMin)
+        {
+            inputValueMin = other.inputValueMin;
+            outputForInputValueMin = other.outputForInputValueMin;
+        }
+        if (inputValueMax < other.inputValueMax)
+        {
+            inputValueMax = other.inputValueMax;
+            outputForInputValueMax = other.outputForInputValueMax;
+        }
+
+        if (errorMin.errorValue > other.errorMin.errorValue)
+            errorMin = other.errorMin;
+        if (errorMax.errorValue < other.errorMax.errorValue)
+            errorMax = other.errorMax;
+
+        if (other.samples > 0)
+        {
+            const uint32_t mergedSamples = samples + other.samples;
+            errorAvg = (samples * errorAvg + other.samples * other.errorAvg) / (double)mergedSamples;
+            samples = mergedSamples;
+        }
+    }
+
+    void write(std::ostream& stream) const
+    {
+        WriteValue(stream, errorMin);
+        WriteValue(stream, errorMax);
+        WriteValue(stream, inputValueMin);
+        WriteValue(stream, inputValueMax);
+        WriteValue(stream, outputForInputValueMin);
+        WriteValue(stream, outputForInputValueMax);
+        WriteValue(stream, errorAvg);
+        WriteValue(stream, samples);
+        WriteValue(stream, static_cast<uint8_t>(hasResultNaN));
+    }
+
+    bool read(std::istream& stream)
+    {
+        uint8_t resultNaN = 0;
+        ReadValue(stream, errorMin);
+        ReadValue(stream, errorMax);
+        ReadValue(stream, inputValueMin);
+        ReadValue(stream, inputValueMax);
+        ReadValue(stream, outputForInputValueMin);
+        ReadValue(stream, outputForInputValueMax);
+        ReadValue(stream, errorAvg);
+        ReadValue(stream, samples);
+        ReadValue(stream, resultNaN);
+        hasResultNaN = resultNaN != 0;
+        return !stream.fail();
+    }
 };
 std::ostream& operator <<(std::ostream& os, const Error& error)
 {
@@ -542,23 +614,39 @@ void test_error_rsqrt()
     TestError<InvSqrtAccurate, InvSqrtSoftFastApprox2>().execute("software fast (better constants)");
     TestError<InvSqrtAccurate, InvSqrtSoftFastApproxSSE>().execute("software fast (all on SSE)");
     TestError<InvSqrtAccurate, InvSqrtSoftFastApproxSSE2>().execute("software fast (all on SSE, better constants)");
-    TestError<InvSqrtAccurate, InvSqrtSoftFastApproxImproved>().execute("software fast + single Newton-Raphson iteration");
-    TestError<InvSqrtAccurate, InvSqrtSoftFastApproxImproved2>().execute("software fast + single Newton-Raphson iteration (better constants)");
+    TestError<InvSqrtAccurate, InvSqrtSoftFastApproxImproved3>().execute("software fast + single Newton-Raphson iteration");
+    TestError<InvSqrtAccurate, InvSqrtSoftFastApproxImproved4>().execute("software fast + single Newton-Raphson iteration (better constants)");
     TestError<InvSqrtAccurate, InvSqrtSoftFastApproxImprovedSSE1>().execute("software fast + single Newton-Raphson iteration (integer on ALU, float on SSE)");
     TestError<InvSqrtAccurate, InvSqrtSoftFastApproxImprovedSSE2>().execute("software fast + single Newton-Raphson iteration (integer on ALU, float on SSE, better constants)");
     TestError<InvSqrtAccurate, InvSqrtSoftFastApproxImprovedSSE3>().execute("software fast + single Newton-Raphson iteration (all on SSE)");
     TestError<InvSqrtAccurate, InvSqrtSoftFastApproxImprovedSSE4>().execute("software fast + single Newton-Raphson iteration (all on SSE, better constants)");
 }
 
+#if defined(_DEBUG)
+constexpr size_t error_clusters = 3;
+#else
+constexpr size_t error_clusters = 256;
+#endif
+
+void PrintErrorClusters(const ErrorTestData* testData, size_t clusters)
+{
+    printf("Index, %12s, %12s, %12s, %12s, %12s, %12s, %12s\n", "input min", "input max", "out for min", "out for max", "error min", "error max", "error avg");
+    for (size_t i = 0; i < clusters; ++i)
+    {
+        const auto& test = testData[i];
+        printf("%5" PRIiPTR ", %12e, %12e, %12e, %12e, %12e, %12e, %12e\n", i, test.inputValueMin, test.inputValueMax,
+            test.outputForInputValueMin, test.outputForInputValueMax,
+            test.errorMin.errorValue, test.errorMax.errorValue, test.errorAvg);
+        //cout << "Cluster " << i << "<" << test.inputValueMin << ", " << test.inputValueMax << ">:" << endl;
+        //cout << test;
+    }
+}
+
 template<single_float_operation op1, single_float_operation op2>
 class TestErrorCluster
 {
 private:
-#if defined(_DEBUG)
-    static constexpr size_t clusters = 3;
-#else
-    static constexpr size_t clusters = 256;
-#endif
+    static constexpr size_t clusters = error_clusters;
 
     static void testInternal(void* userData, float inputValue, int32_t index)
     {
@@ -583,16 +671,12 @@ public:
         timer.stop();
 
         cout << "Error test: " << testName << ". Duration: " << timer.getDuration() << endl;
-        printf("Index, %12s, %12s, %12s, %12s, %12s, %12s, %12s\n", "input min", "input max", "out for min", "out for max", "error min", "error max", "error avg");
-        for (size_t i = 0; i < clusters; ++i)
-        {
-            const auto& test = testData[i];
-            printf("%5" PRIiPTR ", %12e, %12e, %12e, %12e, %12e, %12e, %12e\n", i, test.inputValueMin, test.inputValueMax,
-                test.outputForInputValueMin, test.outputForInputValueMax,
-                test.errorMin.errorValue, test.errorMax.errorValue, test.errorAvg);
-            //cout << "Cluster " << i << "<" << test.inputValueMin << ", " << test.inputValueMax << ">:" << endl;
-            //cout << test;
-        }
+        PrintErrorClusters(testData, clusters);
+    }
+
+    static void executeRange(ErrorTestData* testData, uint32_t begin, uint32_t end)
+    {
+        IterateFloats(testInternal, testData, begin, end);
     }
 };
 
@@ -605,6 +689,433 @@ void test_error_cluster_rsqrt()
     TestErrorCluster<InvSqrtAccurate, InvSqrtSoftFastApproxImprovedSSE4>().execute("software fast + single Newton-Raphson iteration (all on SSE, better constants)");
 }
 
+
+struct ShardedErrorTest
+{
+    const char* name;
+    void (*executeRange)(ErrorTestData* testData, uint32_t begin, uint32_t end);
+};
+
+const ShardedErrorTest sharded_error_tests[] =
+{
+    { "reference", TestErrorCluster<InvSqrtAccurate, InvSqrtReference>::executeRange },
+    { "hardware fast", TestErrorCluster<InvSqrtAccurate, InvSqrtFast>::executeRange },
+    { "hardware fast + single Newton-Raphson iteration", TestErrorCluster<InvSqrtAccurate, InvSqrtImprovedFast>::executeRange },
+    { "hardware fast + masked + single Newton-Raphson iteration", TestErrorCluster<InvSqrtAccurate, InvSqrtImprovedFastMasked>::executeRange },
+    { "fast vs fast masked (both with single Newton-Raphson iteration)", TestErrorCluster<InvSqrtImprovedFast, InvSqrtImprovedFastMasked>::executeRange },
+    { "software fast", TestErrorCluster<InvSqrtAccurate, InvSqrtSoftFastApprox>::executeRange },
+    { "software fast (better constants)", TestErrorCluster<InvSqrtAccurate, InvSqrtSoftFastApprox2>::executeRange },
+    { "software fast (all on SSE)", TestErrorCluster<InvSqrtAccurate, InvSqrtSoftFastApproxSSE>::executeRange },
+    { "software fast (all on SSE, better constants)", TestErrorCluster<InvSqrtAccurate, InvSqrtSoftFastApproxSSE2>::executeRange },
+    { "software fast + single Newton-Raphson iteration", TestErrorCluster<InvSqrtAccurate, InvSqrtSoftFastApproxImproved3>::executeRange },
+    { "software fast + single Newton-Raphson iteration (better constants)", TestErrorCluster<InvSqrtAccurate, InvSqrtSoftFastApproxImproved4>::executeRange },
+    { "software fast + single Newton-Raphson iteration (integer on ALU, float on SSE)", TestErrorCluster<InvSqrtAccurate, InvSqrtSoftFastApproxImprovedSSE1>::executeRange },
+    { "software fast + single Newton-Raphson iteration (integer on ALU, float on SSE, better constants)", TestErrorCluster<InvSqrtAccurate, InvSqrtSoftFastApproxImprovedSSE2>::executeRange },
+    { "software fast + single Newton-Raphson iteration (all on SSE)", TestErrorCluster<InvSqrtAccurate, InvSqrtSoftFastApproxImprovedSSE3>::executeRange },
+    { "software fast + single Newton-Raphson iteration (all on SSE, better constants)", TestErrorCluster<InvSqrtAccurate, InvSqrtSoftFastApproxImprovedSSE4>::executeRange },
+};
+
+constexpr size_t sharded_error_tests_count = sizeof(sharded_error_tests) / sizeof(sharded_error_tests[0]);
+
+// Partial result of all sharded error tests for one range of bit patterns, stored as binary file.
+struct ErrorShard
+{
+    static constexpr char magic[8] = { 'R', 'S', 'Q', 'R', 'T', 'E', 'S', '1' };
+
+    uint32_t shardIndex = 0;
+    uint32_t shardCount = 0;
+    uint32_t begin = 0;
+    uint32_t end = 0;
+    std::vector<std::string> testNames;
+    std::vector<std::vector<ErrorTestData>> testData; // [test][cluster]
+
+    static uint32_t rangeBegin(uint32_t shardIndex, uint32_t shardCount)
+    {
+        return static_cast<uint32_t>(static_cast<uint64_t>(positive_floats_end) * shardIndex / shardCount);
+    }
+
+    static std::string fileName(uint32_t shardIndex, uint32_t shardCount)
+    {
+        return "rsqrt_error_shard_" + std::to_string(shardIndex) + "_of_" + std::to_string(shardCount) + ".part";
+    }
+
+    bool write(const std::string& fileName) const
+    {
+        // write to temporary file first, so interrupted shard never looks like completed one
+        const std::string tempFileName = fileName + ".tmp";
+        {
+            std::ofstream stream(tempFileName, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+            stream.write(magic, sizeof(magic));
+            WriteValue(stream, shardIndex);
+            WriteValue(stream, shardCount);
+            WriteValue(stream, begin);
+            WriteValue(stream, end);
+            WriteValue(stream, static_cast<uint32_t>(error_clusters));
+            WriteValue(stream, static_cast<uint32_t>(testNames.size()));
+            for (size_t test = 0; test < testNames.size(); ++test)
+            {
+                WriteValue(stream, static_cast<uint32_t>(testNames[test].size()));
+                stream.write(testNames[test].data(), testNames[test].size());
+                for (const auto& cluster : testData[test])
+                    cluster.write(stream);
+            }
+            if (stream.fail())
+                return false;
+        }
+        std::remove(fileName.c_str());
+        return std::rename(tempFileName.c_str(), fileName.c_str()) == 0;
+    }
+
+    bool read(const std::string& fileName)
+    {
+        std::ifstream stream(fileName, std::ifstream::in | std::ifstream::binary);
+        char fileMagic[sizeof(magic)] = {};
+        stream.read(fileMagic, sizeof(fileMagic));
+        if (stream.fail() || memcmp(fileMagic, magic, sizeof(magic)) != 0)
+            return false;
+
+        uint32_t clusters = 0;
+        uint32_t tests = 0;
+        ReadValue(stream, shardIndex);
+        ReadValue(stream, shardCount);
+        ReadValue(stream, begin);
+        ReadValue(stream, end);
+        ReadValue(stream, clusters);
+        ReadValue(stream, tests);
+        if (stream.fail() || clusters != error_clusters || shardIndex >= shardCount)
+            return false;
+
+        testNames.resize(tests);
+        testData.assign(tests, std::vector<ErrorTestData>(clusters));
+        for (uint32_t test = 0; test < tests; ++test)
+        {
+            uint32_t nameLength = 0;
+            ReadValue(stream, nameLength);
+            if (stream.fail() || nameLength > 1024)
+                return false;
+            testNames[test].resize(nameLength);
+            stream.read(&testNames[test][0], nameLength);
+            for (auto& cluster : testData[test])
+                cluster.read(stream);
+        }
+        return !stream.fail();
+    }
+};
+
+int run_error_shard(uint32_t shardIndex, uint32_t shardCount)
+{
+    const std::string fileName = ErrorShard::fileName(shardIndex, shardCount);
+    if (std::ifstream(fileName).good())
+    {
+        cout << "Shard " << shardIndex << "/" << shardCount << " already done: " << fileName << endl;
+        return 0;
+    }
+
+    ErrorShard shard;
+    shard.shardIndex = shardIndex;
+    shard.shardCount = shardCount;
+    shard.begin = ErrorShard::rangeBegin(shardIndex, shardCount);
+    shard.end = ErrorShard::rangeBegin(shardIndex + 1, shardCount);
+    shard.testData.assign(sharded_error_tests_count, std::vector<ErrorTestData>(error_clusters));
+
+    Timer timer;
+    timer.start();
+    for (size_t test = 0; test < sharded_error_tests_count; ++test)
+    {
+        shard.testNames.push_back(sharded_error_tests[test].name);
+        sharded_error_tests[test].executeRange(shard.testData[test].data(), shard.begin, shard.end);
+    }
+    timer.stop();
+
+    if (!shard.write(fileName))
+    {
+        cout << "Can't write shard result to: " << fileName << endl;
+        return -1;
+    }
+    cout << "Shard " << shardIndex << "/" << shardCount << " done. Duration: " << timer.getDuration() << ". Result: " << fileName << endl;
+    return 0;
+}
+
+int merge_error_shards(const std::vector<std::string>& fileNames)
+{
+    std::vector<ErrorShard> shards;
+    for (const auto& fileName : fileNames)
+    {
+        ErrorShard shard;
+        if (!shard.read(fileName))
+        {
+            cout << "Invalid shard file: " << fileName << endl;
+            return -1;
+        }
+        if (!shards.empty() && (shard.shardCount != shards[0].shardCount || shard.testNames != shards[0].testNames))
+        {
+            cout << "Shard file from different sweep: " << fileName << endl;
+            return -1;
+        }
+        shards.push_back(std::move(shard));
+    }
+    if (shards.empty())
+    {
+        cout << "No shard files to merge." << endl;
+        return -1;
+    }
+
+    // merge in shard order, so result doesn't depend on order of files
+    std::sort(shards.begin(), shards.end(), [](const ErrorShard& a, const ErrorShard& b) { return a.shardIndex < b.shardIndex; });
+    shards.erase(std::unique(shards.begin(), shards.end(), [](const ErrorShard& a, const ErrorShard& b) { return a.shardIndex == b.shardIndex; }), shards.end());
+
+    const uint32_t shardCount = shards[0].shardCount;
+    std::vector<uint32_t> missingShards;
+    for (uint32_t shardIndex = 0, next = 0; shardIndex < shardCount; ++shardIndex)
+    {
+        if (next < shards.size() && shards[next].shardIndex == shardIndex)
+            ++next;
+        else
+            missingShards.push_back(shardIndex);
+    }
+
+    const auto& testNames = shards[0].testNames;
+    for (size_t test = 0; test < testNames.size(); ++test)
+    {
+        std::vector<ErrorTestData> clusters(error_clusters);
+        for (const auto& shard : shards)
+            for (size_t cluster = 0; cluster < error_clusters; ++cluster)
+                clusters[cluster].merge(shard.testData[test][cluster]);
+
+        ErrorTestData total;
+        for (const auto& cluster : clusters)
+            total.merge(cluster);
+
+        cout << "Error test: " << testNames[test] << ". Shards: " << shards.size() << " of " << shardCount << endl;
+        cout << total;
+        PrintErrorClusters(clusters.data(), clusters.size());
+    }
+
+    if (!missingShards.empty())
+    {
+        cout << "Incomplete result, missing shards:";
+        for (const auto shardIndex : missingShards)
+            cout << " " << shardIndex;
+        cout << endl << "Run them with: --shard <index>/" << shardCount << endl;
+        return 1;
+    }
+    return 0;
+}
+
+class TestBatch
+{
+private:
+    struct TestData
+    {
+        static constexpr size_t buffSize = 10 * 1024;
+        const KernelInfo* kernel;
+        float input[buffSize];
+        float output[buffSize];
+        size_t usedBuff = 0;
+        uint64_t samples = 0;
+        uint64_t mismatches = 0;
+
+        void compare()
+        {
+            kernel->batch(input, output, usedBuff);
+            for (size_t i = 0; i < usedBuff; ++i)
+            {
+                const float expected = kernel->single(input[i]);
+                if (BitCast<uint32_t>(expected) != BitCast<uint32_t>(output[i]))
+                    ++mismatches;
+            }
+            samples += usedBuff;
+            usedBuff = 0;
+        }
+    };
+
+    static void internalOp(void* userData, float value, int32_t index)
+    {
+        TestData& testData = *reinterpret_cast<TestData*>(userData);
+        testData.input[testData.usedBuff++] = value;
+
+        if (testData.usedBuff >= TestData::buffSize)
+            testData.compare();
+    }
+
+public:
+    void execute(Kernel kernel)
+    {
+        auto testData = std::make_unique<TestData>();
+        testData->kernel = &GetKernelInfo(kernel);
+
+        Timer timer;
+        timer.start();
+        IterateAllPositiveFloats(internalOp, testData.get());
+        if (testData->usedBuff > 0)
+            testData->compare();
+        timer.stop();
+
+        cout << "Batch test: " << testData->kernel->name << ". Duration: " << timer.getDuration() << endl;
+        cout << "\t- batch different from single: " << testData->mismatches << " of " << testData->samples << endl;
+    }
+};
+
+void test_batch_rsqrt()
+{
+    for (uint32_t kernel = 0; kernel < static_cast<uint32_t>(Kernel::Count); ++kernel)
+        TestBatch().execute(static_cast<Kernel>(kernel));
+}
+
+template<single_float_operation op1, single_float_operation op2>
+class TestBitExact
+{
+private:
+    struct TestData
+    {
+        uint64_t samples = 0;
+        uint64_t mismatches = 0;
+        float firstMismatchInput = 0;
+    };
+
+    static void testInternal(void* userData, float inputValue, int32_t index)
+    {
+        TestData& testData = *reinterpret_cast<TestData*>(userData);
+        ++testData.samples;
+        if (BitCast<uint32_t>(op1(inputValue)) != BitCast<uint32_t>(op2(inputValue)) && testData.mismatches++ == 0)
+            testData.firstMismatchInput = inputValue;
+    }
+
+public:
+    void execute(const char* testName)
+    {
+        TestData testData;
+
+        Timer timer;
+        timer.start();
+        IterateAllPositiveFloats(testInternal, &testData);
+        timer.stop();
+
+        cout << "Bit exact test: " << testName << ". Duration: " << timer.getDuration() << endl;
+        cout << "\t- different results: " << testData.mismatches << " of " << testData.samples;
+        if (testData.mismatches > 0)
+            cout << " (first for input=" << testData.firstMismatchInput << ")";
+        cout << endl;
+    }
+};
+
+constexpr size_t falloff_table_size = 1024;
+constexpr float falloff_table_first = 1.0f;
+constexpr float falloff_table_last = 4096.0f;
+
+#if RSQRT_HAS_CONSTEXPR
+constexpr auto falloff_table = MakeInvSqrtTable<falloff_table_size>(falloff_table_first, falloff_table_last);
+static_assert(falloff_table[0] > 0.99f && falloff_table[0] < 1.01f, "unexpected rsqrt(1) in compile time table");
+constexpr auto improved3_table = MakeInvSqrtTable<falloff_table_size, InvSqrtSoftFastApproxImproved3>(falloff_table_first, falloff_table_last);
+constexpr auto improved4_table = MakeInvSqrtTable<falloff_table_size, InvSqrtSoftFastApproxImproved4>(falloff_table_first, falloff_table_last);
+
+template<size_t size>
+void TestConstexprTable(const std::array<float, size>& table, single_float_operation kernel, const char* testName)
+{
+    size_t mismatches = 0;
+    for (size_t i = 0; i < size; ++i)
+    {
+        const float input = InvSqrtTableInput(falloff_table_first, falloff_table_last, size, i);
+        if (BitCast<uint32_t>(table[i]) != BitCast<uint32_t>(kernel(input)))
+            ++mismatches;
+    }
+    cout << "Compile time table: " << testName << ", " << size << " entries, different from runtime kernel: " << mismatches << endl;
+}
+#endif
+
+void test_constexpr_rsqrt()
+{
+    TestBitExact<InvSqrtSoftFastApproxSSE, InvSqrtSoftFastApprox>().execute("software fast (all on SSE) vs constexpr");
+    TestBitExact<InvSqrtSoftFastApproxSSE2, InvSqrtSoftFastApprox2>().execute("software fast (all on SSE, better constants) vs constexpr");
+    TestBitExact<InvSqrtSoftFastApproxImprovedSSE3, InvSqrtSoftFastApproxImprovedConstexpr>().execute("software fast + single Newton-Raphson iteration (all on SSE) vs constexpr");
+    TestBitExact<InvSqrtSoftFastApproxImprovedSSE4, InvSqrtSoftFastApproxImprovedConstexpr2>().execute("software fast + single Newton-Raphson iteration (all on SSE, better constants) vs constexpr");
+
+#if RSQRT_HAS_CONSTEXPR
+    TestConstexprTable(falloff_table, InvSqrtSoftFastApproxImprovedSSE3, "software fast + single Newton-Raphson iteration (all on SSE)");
+    TestConstexprTable(improved3_table, InvSqrtSoftFastApproxImproved3, "software fast + single Newton-Raphson iteration");
+    TestConstexprTable(improved4_table, InvSqrtSoftFastApproxImproved4, "software fast + single Newton-Raphson iteration (better constants)");
+#else
+    cout << "Compile time table: not available, requires C++20 std::bit_cast." << endl;
+#endif
+}
+
+template<single_16bit_operation op1, single_16bit_operation op2, batch_16bit_operation batchOp2, float (*toFloat)(uint16_t)>
+class TestError16Bit
+{
+private:
+    struct TestData : public ErrorTestData
+    {
+        uint32_t mismatches = 0;
+        uint32_t signMismatches = 0;
+        uint32_t nonFiniteMismatches = 0;
+        uint32_t batchMismatches = 0;
+        uint32_t distanceMax = 0;
+        uint16_t distanceMaxInput = 0;
+    };
+
+public:
+    void execute(const char* testName)
+    {
+        // all 16-bit patterns (both signs, NaN payloads) fit in memory, so the batch version is verified in one call
+        std::vector<uint16_t> input(0x10000);
+        std::vector<uint16_t> batchOutput(input.size());
+        for (size_t i = 0; i < input.size(); ++i)
+            input[i] = static_cast<uint16_t>(i);
+
+        TestData testData;
+
+        Timer timer;
+        timer.start();
+        batchOp2(input.data(), batchOutput.data(), input.size());
+        for (size_t i = 0; i < input.size(); ++i)
+        {
+            const uint16_t result1 = op1(input[i]);
+            const uint16_t result2 = op2(input[i]);
+
+            testData.update(toFloat(input[i]), toFloat(result1), toFloat(result2));
+            if (result2 != batchOutput[i])
+                ++testData.batchMismatches;
+            if (result1 == result2)
+                continue;
+
+            ++testData.mismatches;
+            if (!std::isfinite(toFloat(result1)) || !std::isfinite(toFloat(result2)))
+                ++testData.nonFiniteMismatches;
+            else if ((result1 ^ result2) & 0x8000)
+                ++testData.signMismatches;
+            else
+            {
+                // both finite with the same sign, so distance of bit patterns is distance in ulps
+                const uint32_t distance = static_cast<uint32_t>(std::abs(static_cast<int32_t>(result1) - static_cast<int32_t>(result2)));
+                if (testData.distanceMax < distance)
+                {
+                    testData.distanceMax = distance;
+                    testData.distanceMaxInput = input[i];
+                }
+            }
+        }
+        timer.stop();
+
+        cout << "Error test: " << testName << ". Duration: " << timer.getDuration() << endl;
+        cout << testData;
+        cout << "\t- different results: " << testData.mismatches << " of " << input.size() << endl;
+        cout << "\t- different finite results: max distance " << testData.distanceMax << " ulp (input=" << toFloat(testData.distanceMaxInput) << ")" << endl;
+        cout << "\t- different sign: " << testData.signMismatches << endl;
+        cout << "\t- different infinity/NaN: " << testData.nonFiniteMismatches << endl;
+        cout << "\t- batch different from single: " << testData.batchMismatches << endl;
+    }
+};
+
+void test_error_rsqrt_16bit()
+{
+    TestError16Bit<InvSqrtHalfReference, InvSqrtHalfConverted, InvSqrtHalfConvertedBatch, HalfToFloat>().execute("half: convert to float + hardware fast + single Newton-Raphson iteration");
+    TestError16Bit<InvSqrtHalfReference, InvSqrtHalfFast, InvSqrtHalfFastBatch, HalfToFloat>().execute("half: hardware fast");
+    TestError16Bit<InvSqrtHalfReference, InvSqrtHalfImprovedFast, InvSqrtHalfImprovedFastBatch, HalfToFloat>().execute("half: hardware fast + single Newton-Raphson iteration");
+    TestError16Bit<InvSqrtBFloat16Reference, InvSqrtBFloat16Converted, InvSqrtBFloat16ConvertedBatch, BFloat16ToFloat>().execute("bfloat16: convert to float + hardware fast + single Newton-Raphson iteration");
+    TestError16Bit<InvSqrtBFloat16Reference, InvSqrtBFloat16Fast, InvSqrtBFloat16FastBatch, BFloat16ToFloat>().execute("bfloat16: hardware fast");
+    TestError16Bit<InvSqrtBFloat16Reference, InvSqrtBFloat16ImprovedFast, InvSqrtBFloat16ImprovedFastBatch, BFloat16ToFloat>().execute("bfloat16: hardware fast + single Newton-Raphson iteration");
+}
+
 template<single_float_operation op>
 class DumpFloats
 {
@@ -747,13 +1258,66 @@ bool askQuestionYesNoQuit(const char* description)
     return result;
 }
 
-int main()
+bool parseShard(const char* text, uint32_t& shardIndex, uint32_t& shardCount)
 {
+    char* end = nullptr;
+    shardIndex = static_cast<uint32_t>(strtoul(text, &end, 10));
+    if (end == text || *end != '/')
+        return false;
+    const char* countText = end + 1;
+    shardCount = static_cast<uint32_t>(strtoul(countText, &end, 10));
+    return end != countText && *end == '\0' && shardIndex < shardCount;
+}
+
+bool parseStreamSize(const char* text, uint64_t& bytes)
+{
+    constexpr uint64_t megabyte = 1024 * 1024;
+    char* end = nullptr;
+    const uint64_t megabytes = strtoull(text, &end, 10);
+    if (end == text || *end != '\0' || megabytes == 0 || megabytes > std::numeric_limits<uint64_t>::max() / megabyte)
+        return false;
+    bytes = megabytes * megabyte;
+    return true;
+}
+
+void printUsage()
+{
+    cout << "Usage:" << endl;
+    cout << "\tCppTest-RSQRT                      - interactive mode" << endl;
+    cout << "\tCppTest-RSQRT --shard <i>/<n>      - run error tests for shard i of n and store partial result" << endl;
+    cout << "\tCppTest-RSQRT --merge <files...>   - merge partial results into final report" << endl;
+    cout << "\tCppTest-RSQRT --stream [max MB]    - run streaming benchmarks up to given working set (default 4096 MB)," << endl;
+    cout << "\t                                     it must fit in free physical memory" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1)
+    {
+        const std::string command = argv[1];
+        uint32_t shardIndex = 0;
+        uint32_t shardCount = 0;
+        if (command == "--shard" && argc == 3 && parseShard(argv[2], shardIndex, shardCount))
+            return run_error_shard(shardIndex, shardCount);
+        if (command == "--merge" && argc > 2)
+            return merge_error_shards(std::vector<std::string>(argv + 2, argv + argc));
+        uint64_t maxWorkingSet = stream_default_max_working_set;
+        if (command == "--stream" && (argc == 2 || (argc == 3 && parseStreamSize(argv[2], maxWorkingSet))))
+            return bench_rsqrt_stream(maxWorkingSet) ? 0 : -1;
+        printUsage();
+        return -1;
+    }
+
     const bool performBench = askQuestionYesNoQuit("Perform benchmarks?");
     const bool testErrorMinMaxAvg = askQuestionYesNoQuit("Test min/max/avg errors?");
     const bool testErrorMinMaxAvgPerCluster = askQuestionYesNoQuit("Test min/max/avg errors per cluster?");
     const bool createDataDump = askQuestionYesNoQuit("Create data dump?");
     const bool compareDataDump = askQuestionYesNoQuit("Compare test resulst with data dump?");
+    const bool performBench16Bit = askQuestionYesNoQuit("Perform half/bfloat16 benchmarks?");
+    const bool testError16Bit = askQuestionYesNoQuit("Test half/bfloat16 errors (all values)?");
+    const bool testBatch = askQuestionYesNoQuit("Compare batch kernels with single versions?");
+    const bool performStreamBench = askQuestionYesNoQuit("Perform streaming benchmarks (16 KB - 4 GB working sets, needs 4 GB of free memory)?");
+    const bool testConstexpr = askQuestionYesNoQuit("Compare constexpr software kernels with runtime versions?");
 
     if (performBench)
         bench_rsqrt();
@@ -765,6 +1329,16 @@ int main()
         dump_rsqrt_data();
     if (compareDataDump)
         compare_with_dump();
+    if (performBench16Bit)
+        bench_rsqrt_16bit();
+    if (testError16Bit)
+        test_error_rsqrt_16bit();
+    if (testBatch)
+        test_batch_rsqrt();
+    if (performStreamBench)
+        bench_rsqrt_stream();
+    if (testConstexpr)
+        test_constexpr_rsqrt();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,637 @@
+// rsqrt.h : Header-only inverse square root kernels (1 / sqrt(x)) for float, half and bfloat16.
+//
+// Everything here is inline, so kernels can be included into other projects without losing inlining.
+// CppTest-RSQRT.cpp benchmarks and verifies exactly this code.
+
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__has_include)
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+
+#if defined(__cpp_lib_bit_cast)
+#include <bit>
+// Software kernels marked with RSQRT_CONSTEXPR can be evaluated at compile time (requires std::bit_cast, C++20).
+#define RSQRT_HAS_CONSTEXPR 1
+#define RSQRT_CONSTEXPR constexpr
+#else
+#define RSQRT_HAS_CONSTEXPR 0
+#define RSQRT_CONSTEXPR inline
+#endif
+
+#include <intrin.h>
+
+namespace rsqrt
+{
+
+using single_float_operation = float (*)(float);
+using batch_float_operation = void (*)(const float* input, float* output, size_t count);
+using stream_float_operation = void (*)(const float* input, float* output, size_t count, bool nonTemporal, bool prefetch);
+using single_16bit_operation = uint16_t (*)(uint16_t);
+using batch_16bit_operation = void (*)(const uint16_t* input, uint16_t* output, size_t count);
+
+// Strict-aliasing-safe replacement for pointer/union punning, compilers reduce it to a register move.
+template<typename To, typename From>
+RSQRT_CONSTEXPR To BitCast(const From& value)
+{
+    static_assert(sizeof(To) == sizeof(From), "BitCast requires types of the same size");
+    static_assert(std::is_trivially_copyable<To>::value && std::is_trivially_copyable<From>::value, "BitCast requires trivially copyable types");
+#if RSQRT_HAS_CONSTEXPR
+    return std::bit_cast<To>(value);
+#else
+    To result;
+    memcpy(&result, &value, sizeof(result));
+    return result;
+#endif
+}
+
+constexpr uint32_t soft_magic_constant = 0x5f3759df;
+constexpr uint32_t soft_magic_constant_better = 0x5F1FFFF9;
+constexpr int32_t least_significant_mantisa_mask = 0b11111111111111111110000000000000;
+
+constexpr uint16_t half_infinity = 0x7C00;
+constexpr uint16_t bfloat16_infinity = 0x7F80;
+
+// Input value for index of table generated by MakeInvSqrtTable.
+constexpr float InvSqrtTableInput(float first, float last, size_t size, size_t index)
+{
+    return first + (last - first) * static_cast<float>(index) / static_cast<float>(size - 1);
+}
+
+inline float InvSqrtReference(float arg)
+{
+    return 1.0f / std::sqrt(arg);
+}
+
+inline float InvSqrtAccurate(float arg)
+{
+    const __m128 vec = _mm_load_ss(&arg);
+    const __m128 sqrt = _mm_sqrt_ss(vec);
+    const __m128 rsqrt = _mm_div_ss(_mm_set_ss(1.0f), sqrt);
+    return _mm_cvtss_f32(rsqrt);
+}
+
+inline float InvSqrtAccurate2(float arg)
+{
+    return _mm_cvtss_f32(_mm_div_ss(_mm_set_ss(1.0f), _mm_sqrt_ss(_mm_load_ss(&arg))));
+}
+
+inline float InvSqrtFast(float arg)
+{
+    const __m128 vec = _mm_load_ss(&arg);
+    const __m128 guess = _mm_rsqrt_ss(vec);
+    return _mm_cvtss_f32(guess);
+}
+
+inline float InvSqrtFast2(float arg)
+{
+    return _mm_cvtss_f32(_mm_rsqrt_ss(_mm_load_ss(&arg)));
+}
+
+inline float InvSqrtImprovedFast(float arg)
+{
+    const __m128 vec = _mm_load_ss(&arg);
+    __m128 guess = _mm_rsqrt_ss(vec);
+    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(_mm_set_ss(-0.5f), _mm_mul_ss(vec, _mm_mul_ss(guess, guess)))));
+    return _mm_cvtss_f32(guess);
+}
+
+inline float InvSqrtImprovedFast2(float arg)
+{
+    const __m128 vec = _mm_load_ss(&arg);
+    __m128 guess = _mm_rsqrt_ss(vec);
+    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(_mm_set_ss(-0.5f), _mm_mul_ss(vec, _mm_mul_ss(guess, guess)))));
+    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(_mm_set_ss(-0.5f), _mm_mul_ss(vec, _mm_mul_ss(guess, guess)))));
+    return _mm_cvtss_f32(guess);
+}
+
+inline float InvSqrtImprovedFast3(float arg)
+{
+    const __m128 vec = _mm_load_ss(&arg);
+    const __m128 vec2 = _mm_mul_ss(_mm_set_ss(-0.5f), vec);
+    __m128 guess = _mm_rsqrt_ss(vec);
+    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(vec2, _mm_mul_ss(guess, guess))));
+    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(vec2, _mm_mul_ss(guess, guess))));
+    return _mm_cvtss_f32(guess);
+}
+
+inline float InvSqrtFastMasked(float arg)
+{
+    const __m128 vec = _mm_load_ss(&arg);
+    const __m128 mantisa_mask = _mm_castsi128_ps(_mm_set1_epi32(least_significant_mantisa_mask));
+    __m128 guess = _mm_rsqrt_ss(vec);
+    guess = _mm_and_ps(mantisa_mask, guess);
+    return _mm_cvtss_f32(guess);
+}
+
+inline float InvSqrtImprovedFastMasked(float arg)
+{
+    const __m128 vec = _mm_load_ss(&arg);
+    const __m128 mantisa_mask = _mm_castsi128_ps(_mm_set1_epi32(least_significant_mantisa_mask));
+    __m128 guess = _mm_rsqrt_ss(vec);
+    guess = _mm_and_ps(mantisa_mask, guess);
+    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(_mm_set_ss(-0.5f), _mm_mul_ss(vec, _mm_mul_ss(guess, guess)))));
+    return _mm_cvtss_f32(guess);
+}
+
+inline float InvSqrtImprovedFastMasked2(float arg)
+{
+    const __m128 vec = _mm_load_ss(&arg);
+    const __m128 mantisa_mask = _mm_castsi128_ps(_mm_set1_epi32(least_significant_mantisa_mask));
+    __m128 guess = _mm_rsqrt_ss(vec);
+    guess = _mm_and_ps(mantisa_mask, guess);
+    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(_mm_set_ss(-0.5f), _mm_mul_ss(vec, _mm_mul_ss(guess, guess)))));
+    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(_mm_set_ss(-0.5f), _mm_mul_ss(vec, _mm_mul_ss(guess, guess)))));
+    return _mm_cvtss_f32(guess);
+}
+
+RSQRT_CONSTEXPR float InvSqrtSoftFastApprox(float arg)
+{
+    return BitCast<float>(soft_magic_constant - (BitCast<uint32_t>(arg) >> 1));
+}
+
+RSQRT_CONSTEXPR float InvSqrtSoftFastApprox2(float arg)
+{
+    return BitCast<float>(soft_magic_constant_better - (BitCast<uint32_t>(arg) >> 1));
+}
+
+inline float InvSqrtSoftFastApproxSSE(float arg)
+{
+    const __m128 number = _mm_load_ss(&arg);
+    __m128 guess = _mm_castsi128_ps(_mm_sub_epi32(_mm_set1_epi32(soft_magic_constant), _mm_srai_epi32(_mm_castps_si128(number), 1)));
+    return _mm_cvtss_f32(guess);
+}
+
+inline float InvSqrtSoftFastApproxSSE2(float arg)
+{
+    const __m128 number = _mm_load_ss(&arg);
+    __m128 guess = _mm_castsi128_ps(_mm_sub_epi32(_mm_set1_epi32(soft_magic_constant_better), _mm_srai_epi32(_mm_castps_si128(number), 1)));
+    return _mm_cvtss_f32(guess);
+}
+
+RSQRT_CONSTEXPR float InvSqrtSoftFastApproxImproved3(float arg)
+{
+    const float x2 = arg * 0.5F;
+    const float y = BitCast<float>(soft_magic_constant - (BitCast<uint32_t>(arg) >> 1));
+    return y * (1.5F - (x2 * y * y));
+}
+
+RSQRT_CONSTEXPR float InvSqrtSoftFastApproxImproved4(float arg)
+{
+    const float y = BitCast<float>(soft_magic_constant_better - (BitCast<uint32_t>(arg) >> 1));
+    return y * (0.703952253f * (2.38924456f - (arg * y * y)));
+}
+
+inline float InvSqrtSoftFastApproxImprovedSSE1(float arg)
+{
+    const uint32_t guessInt = soft_magic_constant - (BitCast<uint32_t>(arg) >> 1);
+    __m128 guess = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int32_t>(guessInt)));
+    const __m128 arg2 = _mm_mul_ss(_mm_set_ss(-0.5f), _mm_load_ss(&arg));
+    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(arg2, _mm_mul_ss(guess, guess))));
+    return _mm_cvtss_f32(guess);
+}
+
+inline float InvSqrtSoftFastApproxImprovedSSE2(float arg)
+{
+    const uint32_t guessInt = soft_magic_constant_better - (BitCast<uint32_t>(arg) >> 1);
+    __m128 guess = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int32_t>(guessInt)));
+    guess = _mm_mul_ss(_mm_set_ss(0.703952253f), _mm_mul_ss(guess, _mm_sub_ss(_mm_set_ss(2.38924456f), _mm_mul_ss(_mm_load_ss(&arg), _mm_mul_ss(guess, guess)))));
+    return _mm_cvtss_f32(guess);
+}
+
+inline float InvSqrtSoftFastApproxImprovedSSE3(float arg)
+{
+    const __m128 number = _mm_load_ss(&arg);
+    __m128 guess = _mm_castsi128_ps(_mm_sub_epi32(_mm_set1_epi32(soft_magic_constant), _mm_srai_epi32(_mm_castps_si128(number), 1)));
+    const __m128 arg2 = _mm_mul_ss(_mm_set_ss(-0.5f), number);
+    guess = _mm_mul_ss(guess, _mm_add_ss(_mm_set_ss(1.5f), _mm_mul_ss(arg2, _mm_mul_ss(guess, guess))));
+    return _mm_cvtss_f32(guess);
+}
+
+inline float InvSqrtSoftFastApproxImprovedSSE4(float arg)
+{
+    const __m128 number = _mm_load_ss(&arg);
+    __m128 guess = _mm_castsi128_ps(_mm_sub_epi32(_mm_set1_epi32(soft_magic_constant_better), _mm_srai_epi32(_mm_castps_si128(number), 1)));
+    guess = _mm_mul_ss(_mm_set_ss(0.703952253f), _mm_mul_ss(guess, _mm_sub_ss(_mm_set_ss(2.38924456f), _mm_mul_ss(number, _mm_mul_ss(guess, guess)))));
+    return _mm_cvtss_f32(guess);
+}
+
+// Plain C++ versions of InvSqrtSoftFastApproxImprovedSSE3/SSE4 with the same operation order (bit-identical results),
+// usable at compile time. Arithmetic shift and wrapping subtraction match _mm_srai_epi32 and _mm_sub_epi32.
+
+RSQRT_CONSTEXPR float InvSqrtSoftFastApproxImprovedConstexpr(float arg)
+{
+    const uint32_t guessInt = soft_magic_constant - static_cast<uint32_t>(BitCast<int32_t>(arg) >> 1);
+    const float guess = BitCast<float>(guessInt);
+    const float arg2 = -0.5f * arg;
+    return guess * (1.5f + arg2 * (guess * guess));
+}
+
+RSQRT_CONSTEXPR float InvSqrtSoftFastApproxImprovedConstexpr2(float arg)
+{
+    const uint32_t guessInt = soft_magic_constant_better - static_cast<uint32_t>(BitCast<int32_t>(arg) >> 1);
+    const float guess = BitCast<float>(guessInt);
+    return 0.703952253f * (guess * (2.38924456f - arg * (guess * guess)));
+}
+
+// Lookup table of kernel results for size inputs evenly spaced over [first, last]. With RSQRT_HAS_CONSTEXPR it can
+// initialize constexpr variable, so the table is computed during build instead of at startup.
+template<size_t size, single_float_operation kernel = InvSqrtSoftFastApproxImprovedConstexpr>
+RSQRT_CONSTEXPR std::array<float, size> MakeInvSqrtTable(float first, float last)
+{
+    static_assert(size > 1, "table needs at least two entries");
+    std::array<float, size> table{};
+    for (size_t i = 0; i < size; ++i)
+        table[i] = kernel(InvSqrtTableInput(first, last, size, i));
+    return table;
+}
+
+// Packed (4 lanes) versions of the kernels above, used by batch functions.
+
+inline __m128 InvSqrtAccurate_ps(__m128 vec)
+{
+    return _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(vec));
+}
+
+inline __m128 InvSqrtFast_ps(__m128 vec)
+{
+    return _mm_rsqrt_ps(vec);
+}
+
+inline __m128 InvSqrtImprovedFast_ps(__m128 vec)
+{
+    const __m128 guess = _mm_rsqrt_ps(vec);
+    return _mm_mul_ps(guess, _mm_add_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_set1_ps(-0.5f), _mm_mul_ps(vec, _mm_mul_ps(guess, guess)))));
+}
+
+inline __m128 InvSqrtImprovedFast3_ps(__m128 vec)
+{
+    const __m128 vec2 = _mm_mul_ps(_mm_set1_ps(-0.5f), vec);
+    __m128 guess = _mm_rsqrt_ps(vec);
+    guess = _mm_mul_ps(guess, _mm_add_ps(_mm_set1_ps(1.5f), _mm_mul_ps(vec2, _mm_mul_ps(guess, guess))));
+    guess = _mm_mul_ps(guess, _mm_add_ps(_mm_set1_ps(1.5f), _mm_mul_ps(vec2, _mm_mul_ps(guess, guess))));
+    return guess;
+}
+
+inline __m128 InvSqrtImprovedFastMasked_ps(__m128 vec)
+{
+    const __m128 mantisa_mask = _mm_castsi128_ps(_mm_set1_epi32(least_significant_mantisa_mask));
+    __m128 guess = _mm_and_ps(mantisa_mask, _mm_rsqrt_ps(vec));
+    guess = _mm_mul_ps(guess, _mm_add_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_set1_ps(-0.5f), _mm_mul_ps(vec, _mm_mul_ps(guess, guess)))));
+    return guess;
+}
+
+inline __m128 InvSqrtSoftFastApproxImprovedSSE3_ps(__m128 vec)
+{
+    __m128 guess = _mm_castsi128_ps(_mm_sub_epi32(_mm_set1_epi32(soft_magic_constant), _mm_srai_epi32(_mm_castps_si128(vec), 1)));
+    const __m128 arg2 = _mm_mul_ps(_mm_set1_ps(-0.5f), vec);
+    guess = _mm_mul_ps(guess, _mm_add_ps(_mm_set1_ps(1.5f), _mm_mul_ps(arg2, _mm_mul_ps(guess, guess))));
+    return guess;
+}
+
+inline __m128 InvSqrtSoftFastApproxImprovedSSE4_ps(__m128 vec)
+{
+    __m128 guess = _mm_castsi128_ps(_mm_sub_epi32(_mm_set1_epi32(soft_magic_constant_better), _mm_srai_epi32(_mm_castps_si128(vec), 1)));
+    guess = _mm_mul_ps(_mm_set1_ps(0.703952253f), _mm_mul_ps(guess, _mm_sub_ps(_mm_set1_ps(2.38924456f), _mm_mul_ps(vec, _mm_mul_ps(guess, guess)))));
+    return guess;
+}
+
+constexpr size_t stream_prefetch_distance = 512; // in floats, 2 KB ahead
+
+// Batch loop for arrays larger than cache. Non-temporal stores write output around the cache (useful when it
+// won't be read soon), prefetch requests input ahead of use. Input and output may be the same array.
+template<__m128 (*kernel)(__m128), single_float_operation single, bool nonTemporal, size_t prefetchDistance>
+inline void InvSqrtBatchStream(const float* input, float* output, size_t count)
+{
+    size_t i = 0;
+    if (nonTemporal)
+    {
+        // streaming stores require aligned output
+        for (; i < count && (reinterpret_cast<uintptr_t>(output + i) & 15) != 0; ++i)
+            output[i] = single(input[i]);
+    }
+    const size_t start = i;
+    for (; i + 4 <= count; i += 4)
+    {
+        // one prefetch per 64-byte line; never form a pointer past the end of input
+        if (prefetchDistance > 0 && ((i - start) & 15) == 0 && prefetchDistance < count - i)
+            _mm_prefetch(reinterpret_cast<const char*>(input + i + prefetchDistance), _MM_HINT_T0);
+        const __m128 result = kernel(_mm_loadu_ps(input + i));
+        if (nonTemporal)
+            _mm_stream_ps(output + i, result);
+        else
+            _mm_storeu_ps(output + i, result);
+    }
+    if (nonTemporal)
+        _mm_sfence();
+    for (; i < count; ++i)
+        output[i] = single(input[i]);
+}
+
+template<__m128 (*kernel)(__m128), single_float_operation single>
+inline void InvSqrtBatch(const float* input, float* output, size_t count)
+{
+    InvSqrtBatchStream<kernel, single, false, 0>(input, output, count);
+}
+
+template<__m128 (*kernel)(__m128), single_float_operation single>
+inline void InvSqrtStream(const float* input, float* output, size_t count, bool nonTemporal, bool prefetch)
+{
+    if (nonTemporal && prefetch)
+        InvSqrtBatchStream<kernel, single, true, stream_prefetch_distance>(input, output, count);
+    else if (nonTemporal)
+        InvSqrtBatchStream<kernel, single, true, 0>(input, output, count);
+    else if (prefetch)
+        InvSqrtBatchStream<kernel, single, false, stream_prefetch_distance>(input, output, count);
+    else
+        InvSqrtBatchStream<kernel, single, false, 0>(input, output, count);
+}
+
+inline void InvSqrtAccurateBatch(const float* input, float* output, size_t count)
+{
+    InvSqrtBatch<InvSqrtAccurate_ps, InvSqrtAccurate>(input, output, count);
+}
+
+inline void InvSqrtFastBatch(const float* input, float* output, size_t count)
+{
+    InvSqrtBatch<InvSqrtFast_ps, InvSqrtFast>(input, output, count);
+}
+
+inline void InvSqrtImprovedFastBatch(const float* input, float* output, size_t count)
+{
+    InvSqrtBatch<InvSqrtImprovedFast_ps, InvSqrtImprovedFast>(input, output, count);
+}
+
+inline void InvSqrtImprovedFast3Batch(const float* input, float* output, size_t count)
+{
+    InvSqrtBatch<InvSqrtImprovedFast3_ps, InvSqrtImprovedFast3>(input, output, count);
+}
+
+inline void InvSqrtImprovedFastMaskedBatch(const float* input, float* output, size_t count)
+{
+    InvSqrtBatch<InvSqrtImprovedFastMasked_ps, InvSqrtImprovedFastMasked>(input, output, count);
+}
+
+inline void InvSqrtSoftFastApproxImprovedSSE3Batch(const float* input, float* output, size_t count)
+{
+    InvSqrtBatch<InvSqrtSoftFastApproxImprovedSSE3_ps, InvSqrtSoftFastApproxImprovedSSE3>(input, output, count);
+}
+
+inline void InvSqrtSoftFastApproxImprovedSSE4Batch(const float* input, float* output, size_t count)
+{
+    InvSqrtBatch<InvSqrtSoftFastApproxImprovedSSE4_ps, InvSqrtSoftFastApproxImprovedSSE4>(input, output, count);
+}
+
+// Half (IEEE 754 binary16, F16C conversions) and bfloat16 (upper half of float) kernels.
+
+inline float HalfToFloat(uint16_t arg)
+{
+    return _mm_cvtss_f32(_mm_cvtph_ps(_mm_cvtsi32_si128(arg)));
+}
+
+inline uint16_t FloatToHalf(float arg)
+{
+    return static_cast<uint16_t>(_mm_cvtsi128_si32(_mm_cvtps_ph(_mm_set_ss(arg), _MM_FROUND_TO_NEAREST_INT)));
+}
+
+inline float BFloat16ToFloat(uint16_t arg)
+{
+    return BitCast<float>(static_cast<uint32_t>(arg) << 16);
+}
+
+inline uint16_t FloatToBFloat16(float arg)
+{
+    const uint32_t bits = BitCast<uint32_t>(arg);
+    if (std::isnan(arg))
+        return static_cast<uint16_t>((bits >> 16) | 0x0040); // keep it quiet, truncation could turn it into infinity
+    // round to nearest, ties to even
+    return static_cast<uint16_t>((bits + 0x7FFF + ((bits >> 16) & 1)) >> 16);
+}
+
+inline __m128 LoadHalf4(const uint16_t* input)
+{
+    return _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(input)));
+}
+
+inline void StoreHalf4(uint16_t* output, __m128 value)
+{
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(output), _mm_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT));
+}
+
+inline __m128 LoadBFloat16x4(const uint16_t* input)
+{
+    return _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(), _mm_loadl_epi64(reinterpret_cast<const __m128i*>(input))));
+}
+
+inline void StoreBFloat16x4(uint16_t* output, __m128 value)
+{
+    // Same rounding as FloatToBFloat16. NaNs produced by rsqrt are quiet, so they can't round into infinity here.
+    const __m128i bits = _mm_castps_si128(value);
+    const __m128i lsb = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(1));
+    const __m128i rounded = _mm_srai_epi32(_mm_add_epi32(bits, _mm_add_epi32(lsb, _mm_set1_epi32(0x7FFF))), 16);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(output), _mm_packs_epi32(rounded, rounded));
+}
+
+inline __m128 Select_ps(__m128 mask, __m128 ifTrue, __m128 ifFalse)
+{
+    return _mm_or_ps(_mm_and_ps(mask, ifTrue), _mm_andnot_ps(mask, ifFalse));
+}
+
+inline __m128 IsDenormal_ps(__m128 vec)
+{
+    const __m128 absVec = _mm_andnot_ps(_mm_set1_ps(-0.0f), vec);
+    return _mm_and_ps(_mm_cmpneq_ps(vec, _mm_setzero_ps()), _mm_cmplt_ps(absVec, _mm_set1_ps(FLT_MIN)));
+}
+
+// _mm_rsqrt_ps treats denormal inputs as zero. bfloat16 can hold float denormals, so for it (scaleDenormals)
+// they're moved to normal range by 2^24 before the seed and the result is scaled back by 2^12. Negative ones are
+// scaled too, so they give NaN instead of -inf.
+template<bool scaleDenormals>
+inline __m128 InvSqrt16BitFast_ps(__m128 vec)
+{
+    if (!scaleDenormals)
+        return _mm_rsqrt_ps(vec);
+    const __m128 denormal = IsDenormal_ps(vec);
+    const __m128 guess = _mm_rsqrt_ps(Select_ps(denormal, _mm_mul_ps(vec, _mm_set1_ps(16777216.0f)), vec));
+    return Select_ps(denormal, _mm_mul_ps(guess, _mm_set1_ps(4096.0f)), guess);
+}
+
+// Same as InvSqrtImprovedFast_ps, but zero and infinity keep the exact seed (inf and 0), Newton-Raphson step would
+// turn them into NaN.
+template<bool scaleDenormals>
+inline __m128 InvSqrt16BitImprovedFast_ps(__m128 vec)
+{
+    const __m128 denormal = scaleDenormals ? IsDenormal_ps(vec) : _mm_setzero_ps();
+    const __m128 scaled = scaleDenormals ? Select_ps(denormal, _mm_mul_ps(vec, _mm_set1_ps(16777216.0f)), vec) : vec;
+    const __m128 guess = _mm_rsqrt_ps(scaled);
+    const __m128 improved = _mm_mul_ps(guess, _mm_add_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_set1_ps(-0.5f), _mm_mul_ps(scaled, _mm_mul_ps(guess, guess)))));
+    const __m128 absGuess = _mm_andnot_ps(_mm_set1_ps(-0.0f), guess);
+    const __m128 exact = _mm_or_ps(_mm_cmpeq_ps(guess, _mm_setzero_ps()), _mm_cmpeq_ps(absGuess, _mm_set1_ps(INFINITY)));
+    const __m128 result = Select_ps(exact, guess, improved);
+    return scaleDenormals ? Select_ps(denormal, _mm_mul_ps(result, _mm_set1_ps(4096.0f)), result) : result;
+}
+
+template<__m128 (*load)(const uint16_t*), void (*store)(uint16_t*, __m128), __m128 (*kernel)(__m128), single_16bit_operation single>
+inline void InvSqrt16BitBatch(const uint16_t* input, uint16_t* output, size_t count)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+        store(output + i, kernel(load(input + i)));
+    for (; i < count; ++i)
+        output[i] = single(input[i]);
+}
+
+inline uint16_t InvSqrtHalfReference(uint16_t arg)
+{
+    return FloatToHalf(InvSqrtAccurate(HalfToFloat(arg)));
+}
+
+// Baseline going through float kernel, it keeps InvSqrtImprovedFast limitations (NaN for zero and infinity,
+// bfloat16 denormals give infinity).
+inline uint16_t InvSqrtHalfConverted(uint16_t arg)
+{
+    return FloatToHalf(InvSqrtImprovedFast(HalfToFloat(arg)));
+}
+
+inline uint16_t InvSqrtHalfFast(uint16_t arg)
+{
+    return FloatToHalf(_mm_cvtss_f32(InvSqrt16BitFast_ps<false>(_mm_set_ss(HalfToFloat(arg)))));
+}
+
+inline uint16_t InvSqrtHalfImprovedFast(uint16_t arg)
+{
+    return FloatToHalf(_mm_cvtss_f32(InvSqrt16BitImprovedFast_ps<false>(_mm_set_ss(HalfToFloat(arg)))));
+}
+
+inline void InvSqrtHalfConvertedBatch(const uint16_t* input, uint16_t* output, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        output[i] = InvSqrtHalfConverted(input[i]);
+}
+
+inline void InvSqrtHalfFastBatch(const uint16_t* input, uint16_t* output, size_t count)
+{
+    InvSqrt16BitBatch<LoadHalf4, StoreHalf4, InvSqrt16BitFast_ps<false>, InvSqrtHalfFast>(input, output, count);
+}
+
+inline void InvSqrtHalfImprovedFastBatch(const uint16_t* input, uint16_t* output, size_t count)
+{
+    InvSqrt16BitBatch<LoadHalf4, StoreHalf4, InvSqrt16BitImprovedFast_ps<false>, InvSqrtHalfImprovedFast>(input, output, count);
+}
+
+inline uint16_t InvSqrtBFloat16Reference(uint16_t arg)
+{
+    return FloatToBFloat16(InvSqrtAccurate(BFloat16ToFloat(arg)));
+}
+
+inline uint16_t InvSqrtBFloat16Converted(uint16_t arg)
+{
+    return FloatToBFloat16(InvSqrtImprovedFast(BFloat16ToFloat(arg)));
+}
+
+inline uint16_t InvSqrtBFloat16Fast(uint16_t arg)
+{
+    return FloatToBFloat16(_mm_cvtss_f32(InvSqrt16BitFast_ps<true>(_mm_set_ss(BFloat16ToFloat(arg)))));
+}
+
+inline uint16_t InvSqrtBFloat16ImprovedFast(uint16_t arg)
+{
+    return FloatToBFloat16(_mm_cvtss_f32(InvSqrt16BitImprovedFast_ps<true>(_mm_set_ss(BFloat16ToFloat(arg)))));
+}
+
+inline void InvSqrtBFloat16ConvertedBatch(const uint16_t* input, uint16_t* output, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        output[i] = InvSqrtBFloat16Converted(input[i]);
+}
+
+inline void InvSqrtBFloat16FastBatch(const uint16_t* input, uint16_t* output, size_t count)
+{
+    InvSqrt16BitBatch<LoadBFloat16x4, StoreBFloat16x4, InvSqrt16BitFast_ps<true>, InvSqrtBFloat16Fast>(input, output, count);
+}
+
+inline void InvSqrtBFloat16ImprovedFastBatch(const uint16_t* input, uint16_t* output, size_t count)
+{
+    InvSqrt16BitBatch<LoadBFloat16x4, StoreBFloat16x4, InvSqrt16BitImprovedFast_ps<true>, InvSqrtBFloat16ImprovedFast>(input, output, count);
+}
+
+// Kernel selection. Values are stored by users (configs, files), so only append new entries. Check loaded values
+// with IsValidKernel or FindKernelInfo before passing them to InvSqrt.
+enum class Kernel : uint32_t
+{
+    Accurate = 0,
+    Fast = 1,
+    ImprovedFast = 2,
+    ImprovedFast2 = 3,
+    ImprovedFastMasked = 4,
+    SoftFastApproxImproved = 5,
+    SoftFastApproxImprovedBetterConstants = 6,
+
+    Count
+};
+
+struct KernelInfo
+{
+    Kernel kernel;
+    const char* name;
+    single_float_operation single;
+    batch_float_operation batch;
+    stream_float_operation stream;
+};
+
+inline bool IsValidKernel(Kernel kernel)
+{
+    return static_cast<uint32_t>(kernel) < static_cast<uint32_t>(Kernel::Count);
+}
+
+// Lookup for values from outside the program (configs, files), nullptr for unknown kernels.
+inline const KernelInfo* FindKernelInfo(Kernel kernel)
+{
+    static const KernelInfo kernels[] =
+    {
+        { Kernel::Accurate, "hardware accurate", InvSqrtAccurate, InvSqrtAccurateBatch, InvSqrtStream<InvSqrtAccurate_ps, InvSqrtAccurate> },
+        { Kernel::Fast, "hardware fast", InvSqrtFast, InvSqrtFastBatch, InvSqrtStream<InvSqrtFast_ps, InvSqrtFast> },
+        { Kernel::ImprovedFast, "hardware fast + single Newton-Raphson iteration", InvSqrtImprovedFast, InvSqrtImprovedFastBatch, InvSqrtStream<InvSqrtImprovedFast_ps, InvSqrtImprovedFast> },
+        { Kernel::ImprovedFast2, "hardware fast + two Newton-Raphson iterations", InvSqrtImprovedFast3, InvSqrtImprovedFast3Batch, InvSqrtStream<InvSqrtImprovedFast3_ps, InvSqrtImprovedFast3> },
+        { Kernel::ImprovedFastMasked, "hardware fast masked + single Newton-Raphson iteration", InvSqrtImprovedFastMasked, InvSqrtImprovedFastMaskedBatch, InvSqrtStream<InvSqrtImprovedFastMasked_ps, InvSqrtImprovedFastMasked> },
+        { Kernel::SoftFastApproxImproved, "software fast + single Newton-Raphson iteration", InvSqrtSoftFastApproxImprovedSSE3, InvSqrtSoftFastApproxImprovedSSE3Batch, InvSqrtStream<InvSqrtSoftFastApproxImprovedSSE3_ps, InvSqrtSoftFastApproxImprovedSSE3> },
+        { Kernel::SoftFastApproxImprovedBetterConstants, "software fast + single Newton-Raphson iteration (better constants)", InvSqrtSoftFastApproxImprovedSSE4, InvSqrtSoftFastApproxImprovedSSE4Batch, InvSqrtStream<InvSqrtSoftFastApproxImprovedSSE4_ps, InvSqrtSoftFastApproxImprovedSSE4> },
+    };
+    static_assert(sizeof(kernels) / sizeof(kernels[0]) == static_cast<size_t>(Kernel::Count), "missing kernel info");
+    return IsValidKernel(kernel) ? &kernels[static_cast<size_t>(kernel)] : nullptr;
+}
+
+// Lookup for known valid kernels, validate stored values with IsValidKernel or use FindKernelInfo.
+inline const KernelInfo& GetKernelInfo(Kernel kernel)
+{
+    assert(IsValidKernel(kernel));
+    return *FindKernelInfo(kernel);
+}
+
+inline float InvSqrt(Kernel kernel, float arg)
+{
+    return GetKernelInfo(kernel).single(arg);
+}
+
+inline void InvSqrt(Kernel kernel, const float* input, float* output, size_t count)
+{
+    GetKernelInfo(kernel).batch(input, output, count);
+}
+
+inline void InvSqrt(Kernel kernel, const float* input, float* output, size_t count, bool nonTemporal, bool prefetch)
+{
+    GetKernelInfo(kernel).stream(input, output, count, nonTemporal, prefetch);
+}
+
+} // namespace rsqrt
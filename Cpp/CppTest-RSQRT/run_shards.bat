@@ -0,0 +1,27 @@
+@echo off
+rem Runs error tests as local processes, one per shard, and merges partial results.
+rem Usage: run_shards.bat [shards] (default: number of processors).
+rem Completed shards are skipped, so run it again to finish failed ones.
+setlocal EnableDelayedExpansion
+set SHARDS=%1
+if "%SHARDS%"=="" set SHARDS=%NUMBER_OF_PROCESSORS%
+set /a LAST=%SHARDS%-1
+pushd %~dp0\CppTest-RSQRT
+rem Each shard deletes its marker file when its process exits, so only processes started here are waited for.
+del /q rsqrt_error_shard_*_of_%SHARDS%.running 2>nul
+for /L %%i in (0,1,%LAST%) do (
+    echo.>rsqrt_error_shard_%%i_of_%SHARDS%.running
+    start "shard %%i/%SHARDS%" /b cmd /c "..\x64\Release\CppTest-RSQRT.exe --shard %%i/%SHARDS% & del rsqrt_error_shard_%%i_of_%SHARDS%.running"
+)
+:wait
+timeout /t 5 /nobreak >nul
+if exist rsqrt_error_shard_*_of_%SHARDS%.running goto wait
+set FILES=
+for /L %%i in (0,1,%LAST%) do if exist rsqrt_error_shard_%%i_of_%SHARDS%.part set FILES=!FILES! rsqrt_error_shard_%%i_of_%SHARDS%.part
+if "!FILES!"=="" (
+    echo No shard results.
+) else (
+    call ..\x64\Release\CppTest-RSQRT.exe --merge !FILES!
+)
+popd
+pause